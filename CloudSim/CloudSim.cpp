@@ -33,10 +33,11 @@ GLuint phongProgram, cloudProgram;
 GLuint progs[2];
 GLuint FBOd;
 GLuint renderTex, depthTex;
+GLuint shadowFBO, shadowTex, shadowQuery;
 
 GLuint icoVAO, groundVAO, screenVAO;
 
-uniform matrixUBO, lightUBO, materialUBO, camUBO, cloudUBO;
+uniform matrixUBO, lightUBO, materialUBO, camUBO, cloudUBO, shadowUBO;
 
 GLuint subIndex[4], sub = 0;
 
@@ -65,6 +66,15 @@ float coverage = .7f, cloudScale = 7;
 int mainStepCount = 20;
 int lightStepCount = 10;
 
+// The shadow map covers the ground plane (minX, minZ, maxX, maxZ) and is only rebaked when the clouds change
+int shadowRes = 128;
+vec4 shadowBounds = vec4(-10.0f, -10.0f, 10.0f, 10.0f);
+bool shadowValid = false, shadowQueryPending = false;
+vec3 shadowCloudOffset, shadowDetailOffset;
+float shadowCoverage, shadowCloudScale;
+double shadowBakeMs = 0.0;
+int shadowBakes = 0;
+
 vec2 mousePos = vec2(-10000, -10000);
 bool pressLMB = false;
 
@@ -135,7 +145,10 @@ void initShaders()
 
     cloudProgram = glCreateProgram();
 
+    // The cloud kernels live in cloudNoise.glsl so KernelBench can time the same code
+    strcat(fsSource,"#version 420 core\n");
     readShader("cloudVert.vs",vsSource);
+    readShader("cloudNoise.glsl",fsSource);
     readShader("cloudFrag.fs",fsSource);
 
     vs = loadShader(vsSource,GL_VERTEX_SHADER);
@@ -148,6 +161,10 @@ void initShaders()
 
     progs[0] = phongProgram;
     progs[1] = cloudProgram;
+
+    // The cloud shader either renders the clouds or bakes the shadow map
+    subIndex[0] = glGetSubroutineIndex(cloudProgram, GL_FRAGMENT_SHADER, "rayMarchNoise");
+    subIndex[1] = glGetSubroutineIndex(cloudProgram, GL_FRAGMENT_SHADER, "bakeShadow");
 }
 
 static void error_callback(int error, const char* description)
@@ -204,14 +221,17 @@ void showFPS(GLFWwindow* window) {
         nFrames++;
         if ( delta >= 1.0 ){ // If last update was more than 1 sec ago
             double fps = ((double)(nFrames)) / delta;
+            double bakes = ((double)(shadowBakes)) / delta;
 
             std::string program = "Phong", spec = "Blinn-Phong";
             int prog;
             glGetIntegerv(GL_CURRENT_PROGRAM, &prog);
-            sprintf(ss,"%s running at %lf FPS. We are using %s shading and %s specular illumination.",
-                    wTitle.c_str(),fps, program.c_str(), spec.c_str());
+            sprintf(ss,"%s running at %lf FPS. We are using %s shading and %s specular illumination. "
+                       "Shadow map: %.3lf ms per bake, %.1lf bakes/s.",
+                    wTitle.c_str(),fps, program.c_str(), spec.c_str(), shadowBakeMs, bakes);
             glfwSetWindowTitle(window, ss);
             nFrames = 0;
+            shadowBakes = 0;
             lastTime = currentTime;
         }
 }
@@ -296,6 +316,43 @@ void initFBO() {
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+void initShadowMap() {
+    // Generate and bind the framebuffer
+    glGenFramebuffers(1, &shadowFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO);
+
+    // Single channel texture holding the optical depth through the clouds
+    float border[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    glGenTextures(1, &shadowTex);
+    glBindTexture(GL_TEXTURE_2D, shadowTex);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32F, shadowRes, shadowRes);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+    // Bind the texture to the FBO
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, shadowTex, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0};
+    glDrawBuffers(1, drawBuffers);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        printf("Error in shadow frame buffer: %d\n", glCheckFramebufferStatus(GL_FRAMEBUFFER));
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // Timer for the bake cost
+    glGenQueries(1, &shadowQuery);
+
+    printf("Shadow map           : %dx%d R32F, %.1f KB\n", shadowRes, shadowRes,
+           shadowRes*shadowRes*sizeof(float)/1024.0f);
+}
+
 void initVAOs() {
     GLuint vertpos_buffer;
     GLuint vertnormal_buffer;
@@ -440,12 +497,14 @@ void setUpUniforms() {
     GLchar* camComponents[5] = {"camPosition", "camDirection", "camDist", "nearClip", "farClip"};
     GLchar* cloudComponents[9] = {"coverage", "mainStepCount", "lightStepCount", "cloudColor", "boundingBox",
                                   "cloudScale", "cloudOffset", "detailOffset"};
+    GLchar* shadowComponents[2] = {"shadowBounds", "shadowTop"};
 
     matrixUBO = initUBO(index, 4, "matrixData", matrixComponents, &phongProgram, 1);
     lightUBO = initUBO(index, 4, "lightData", lightComponents, progs, 2);
     materialUBO = initUBO(index, 4, "materialData", materialComponents, &phongProgram, 1);
     camUBO = initUBO(index, 5, "camData", camComponents, &cloudProgram, 1);
     cloudUBO = initUBO(index, 8, "cloudData", cloudComponents, &cloudProgram, 1);
+    shadowUBO = initUBO(index, 2, "shadowData", shadowComponents, progs, 2);
 
     // Copy static data into GPU
     memcpy(lightUBO.blockBuffer + lightUBO.offsets[0], &lightPos, sizeof(vec4));
@@ -481,6 +540,9 @@ void setUpUniforms() {
     memcpy(cloudUBO.blockBuffer + cloudUBO.offsets[6], &cloudOffset, sizeof(vec3));
     memcpy(cloudUBO.blockBuffer + cloudUBO.offsets[7], &detailOffset, sizeof(vec3));
 
+    memcpy(shadowUBO.blockBuffer + shadowUBO.offsets[0], &shadowBounds, sizeof(vec4));
+    memcpy(shadowUBO.blockBuffer + shadowUBO.offsets[1], &box[1][1], sizeof(float));
+
     glBindBuffer(GL_UNIFORM_BUFFER, lightUBO.ubod);
     glBufferData(GL_UNIFORM_BUFFER, lightUBO.blockSize, lightUBO.blockBuffer, GL_STATIC_DRAW);
 
@@ -492,6 +554,9 @@ void setUpUniforms() {
 
     glBindBuffer(GL_UNIFORM_BUFFER, cloudUBO.ubod);
     glBufferData(GL_UNIFORM_BUFFER, cloudUBO.blockSize, cloudUBO.blockBuffer, GL_DYNAMIC_DRAW);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, shadowUBO.ubod);
+    glBufferData(GL_UNIFORM_BUFFER, shadowUBO.blockSize, shadowUBO.blockBuffer, GL_STATIC_DRAW);
 }
 
 void update() {
@@ -517,6 +582,69 @@ void update() {
 
     cloudOffset += cloudSpeed;
     detailOffset += detailSpeed;
+
+    // Copy Cloud Data
+    memcpy(cloudUBO.blockBuffer + cloudUBO.offsets[6], &cloudOffset, sizeof(vec3));
+    memcpy(cloudUBO.blockBuffer + cloudUBO.offsets[7], &detailOffset, sizeof(vec3));
+    glBindBuffer(GL_UNIFORM_BUFFER, cloudUBO.ubod);
+    glBufferData(GL_UNIFORM_BUFFER, cloudUBO.blockSize, cloudUBO.blockBuffer, GL_DYNAMIC_DRAW);
+}
+
+void shadowPass() {
+    // Collect the timing of the last bake without stalling
+    if (shadowQueryPending) {
+        GLint available = 0;
+        glGetQueryObjectiv(shadowQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint64 elapsed;
+            glGetQueryObjectui64v(shadowQuery, GL_QUERY_RESULT, &elapsed);
+            shadowBakeMs = elapsed / 1000000.0;
+            shadowQueryPending = false;
+        }
+    }
+
+    // Only rebake when the clouds have changed
+    if (shadowValid && shadowCloudOffset == cloudOffset && shadowDetailOffset == detailOffset &&
+        shadowCoverage == coverage && shadowCloudScale == cloudScale) {
+        return;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO);
+    glViewport(0, 0, shadowRes, shadowRes);
+    glDisable(GL_DEPTH_TEST);
+
+    glUseProgram(cloudProgram);
+    glUniformSubroutinesuiv(GL_FRAGMENT_SHADER, 1, &subIndex[1]);
+
+    // The bake does not read the first pass, but the samplers must never point at the shadow map being drawn
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, renderTex);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, depthTex);
+
+    if (!shadowQueryPending) {
+        glBeginQuery(GL_TIME_ELAPSED, shadowQuery);
+    }
+
+    // Render the full-screen quad
+    glBindVertexArray(screenVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glBindVertexArray(0);
+
+    if (!shadowQueryPending) {
+        glEndQuery(GL_TIME_ELAPSED);
+        shadowQueryPending = true;
+    }
+
+    glViewport(0, 0, width, height);
+
+    shadowValid = true;
+    shadowCloudOffset = cloudOffset;
+    shadowDetailOffset = detailOffset;
+    shadowCoverage = coverage;
+    shadowCloudScale = cloudScale;
+    shadowBakes++;
 }
 
 void firstPass() {
@@ -527,6 +655,10 @@ void firstPass() {
 
     glUseProgram(phongProgram);
 
+    // Activate the cloud shadow map
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, shadowTex);
+
     cameraDir = vec3(sin(theta) * sin(phi), cos(phi), sin(phi) * cos(theta));
     cameraDir = glm::normalize(cameraDir);
 
@@ -577,6 +709,7 @@ void firstPass() {
 void secondPass() {
     mat4 identity = mat4(1.0f);
     glUseProgram(cloudProgram);
+    glUniformSubroutinesuiv(GL_FRAGMENT_SHADER, 1, &subIndex[0]);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
     // Activate textures of first pass
@@ -595,12 +728,6 @@ void secondPass() {
     glBindBuffer(GL_UNIFORM_BUFFER, camUBO.ubod);
     glBufferData(GL_UNIFORM_BUFFER, camUBO.blockSize, camUBO.blockBuffer, GL_DYNAMIC_DRAW);
 
-    // Copy Cloud Data
-    memcpy(cloudUBO.blockBuffer + cloudUBO.offsets[6], &cloudOffset, sizeof(vec3));
-    memcpy(cloudUBO.blockBuffer + cloudUBO.offsets[6], &detailOffset, sizeof(vec3));
-    glBindBuffer(GL_UNIFORM_BUFFER, cloudUBO.ubod);
-    glBufferData(GL_UNIFORM_BUFFER, cloudUBO.blockSize, cloudUBO.blockBuffer, GL_DYNAMIC_DRAW);
-
     // Render the full-screen quad
     glBindVertexArray(screenVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -654,6 +781,8 @@ int main(void) {
 
     initFBO();
 
+    initShadowMap();
+
     initShaders();
 
     setUpUniforms();
@@ -666,6 +795,8 @@ int main(void) {
 
         update();
 
+        shadowPass();
+
         firstPass();
 
         secondPass();
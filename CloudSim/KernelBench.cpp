@@ -0,0 +1,668 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <math.h>
+
+#include <glm/glm.hpp>
+using glm::vec2;
+using glm::vec3;
+using glm::vec4;
+using glm::uvec3;
+
+typedef vec4 (*cpuKernel)(vec4 a, vec4 b);
+
+struct kernelBench {
+    const char* name;
+    const char* gpuCurrent;         // Entry points in kernelBench.cs
+    const char* gpuAlternative;
+    cpuKernel cpuCurrent;
+    cpuKernel cpuAlternative;
+    const char* alternative;
+    bool exact;                     // Whether the alternative should reproduce the current results
+    float portTolerance;            // Allowed mean difference between the C++ port and the shipped kernel
+};
+
+struct benchResult {
+    double currentRate, alternativeRate;    // Points per second
+    float maxDiff, meanDiff;
+};
+
+int pointCount = 1 << 18;
+int repetitions = 3;
+
+GLuint inputBuf, outputBuf, cloudBuf, timerQuery;
+
+// Members of cloudData, set at startup so neither compiler can fold them into the kernels
+float coverage;
+int mainStepCount, lightStepCount;
+vec4 cloudColor;
+float boundingBox[6];
+float cloudScale;
+vec3 cloudOffset, detailOffset;
+
+// Default cloud parameters of CloudSim.cpp
+void setCloudDefaults() {
+    static float box[6] = {-8, 5, -8, 8, 15, 8};
+
+    coverage = .7f;
+    mainStepCount = 20;
+    lightStepCount = 10;
+    cloudColor = vec4(1.0f, 0.9f, 0.8f, 1.0f);
+    memcpy(boundingBox, box, sizeof(box));
+    cloudScale = 7;
+    cloudOffset = vec3(0.0f);
+    detailOffset = vec3(0.0f);
+}
+
+// ---- C++ versions of the kernels in cloudNoise.glsl and kernelBench.cs ----
+
+vec2 intersectBox(vec3 rayo, vec3 rayd) {
+    float t[6] = {10001, 10001, 10001, 10001, 10001, 10001};
+
+    if (rayd.x != 0) {
+        t[0] = (boundingBox[0] - rayo.x)/rayd.x;
+        t[3] = (boundingBox[3] - rayo.x)/rayd.x;
+    }
+    if (rayd.y != 0) {
+        t[1] = (boundingBox[1] - rayo.y)/rayd.y;
+        t[4] = (boundingBox[4] - rayo.y)/rayd.y;
+    }
+    if (rayd.z != 0) {
+        t[2] = (boundingBox[2] - rayo.z)/rayd.z;
+        t[5] = (boundingBox[5] - rayo.z)/rayd.z;
+    }
+
+    float min = 10001;
+    float max = 0;
+    for (int i = 0; i < 6; i++) {
+        if (t[i] < 0) {
+            t[i] = 0;
+        }
+        vec3 point = rayo + t[i]*rayd;
+        if (point.x >= boundingBox[0] - .00001f && point.x <= boundingBox[3] + .00001f &&
+            point.y >= boundingBox[1] - .00001f && point.y <= boundingBox[4] + .00001f &&
+            point.z >= boundingBox[2] - .00001f && point.z <= boundingBox[5] + .00001f) {
+            if (t[i] < min) {
+                min = t[i];
+            }
+            if (t[i] > max) {
+                max = t[i];
+            }
+        }
+    }
+
+    return vec2(min, max);
+}
+
+float rand1(float n) {
+    return glm::fract(cosf(n*89.42f)*343.42f);
+}
+
+vec3 rand3(vec3 n) {
+    return vec3(rand1(n.x*23.62f + n.y*34.35f + n.z*29.39f - 300.0f),
+                rand1(n.x*45.13f + n.y*38.89f + n.z*41.05f + 256.0f),
+                rand1(n.x*25.97f + n.y*35.48f + n.z*38.20f - 134.6f));
+}
+
+vec3 hash33(vec3 p3) {
+    p3 = glm::fract(p3 * vec3(0.1031f, 0.11369f, 0.13787f));
+    p3 += glm::dot(p3, vec3(p3.y, p3.x, p3.z) + 19.19f);
+    return -1.0f + 2.0f * glm::fract(vec3((p3.x + p3.y)*p3.z, (p3.x + p3.z)*p3.y, (p3.y + p3.z)*p3.x));
+}
+
+float worley_noise(vec3 n, float s) {
+    float dis = 10001.0f;
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            for (int z = -1; z <= 1; z++) {
+                vec3 p = glm::floor(n/s) + vec3(x, y, z);
+                float d = glm::length(rand3(p) + vec3(x, y, z) - glm::fract(n/s));
+                if (dis > d) {
+                    dis = d;
+                }
+            }
+        }
+    }
+    return 1.0f - dis;
+}
+
+float perlin_noise(vec3 p, float scale) {
+    p *= scale;
+
+    vec3 pi = glm::floor(p);
+    vec3 pf = p - pi;
+
+    vec3 w = pf * pf * (3.0f - 2.0f * pf);
+
+    return glm::mix(
+               glm::mix(
+                   glm::mix(glm::dot(pf - vec3(0, 0, 0), hash33(pi + vec3(0, 0, 0))),
+                            glm::dot(pf - vec3(1, 0, 0), hash33(pi + vec3(1, 0, 0))),
+                            w.x),
+                   glm::mix(glm::dot(pf - vec3(0, 0, 1), hash33(pi + vec3(0, 0, 1))),
+                            glm::dot(pf - vec3(1, 0, 1), hash33(pi + vec3(1, 0, 1))),
+                            w.x),
+                   w.z),
+               glm::mix(
+                   glm::mix(glm::dot(pf - vec3(0, 1, 0), hash33(pi + vec3(0, 1, 0))),
+                            glm::dot(pf - vec3(1, 1, 0), hash33(pi + vec3(1, 1, 0))),
+                            w.x),
+                   glm::mix(glm::dot(pf - vec3(0, 1, 1), hash33(pi + vec3(0, 1, 1))),
+                            glm::dot(pf - vec3(1, 1, 1), hash33(pi + vec3(1, 1, 1))),
+                            w.x),
+                   w.z),
+               w.y);
+}
+
+float densityFalloff(vec3 position, float density) {
+    // Edge fall off
+    float distX = glm::min(position.x - boundingBox[0], boundingBox[3] - position.x);
+    float distZ = glm::min(position.z - boundingBox[2], boundingBox[5] - position.z);
+
+    float edgeWeight = glm::min(1.0f, glm::min(distX, distZ));
+
+    // Normalized height in the box
+    float heightPercent = (position.y - boundingBox[1]) / (boundingBox[4] - boundingBox[1]);
+    float heightReduction = glm::clamp(heightPercent/0.2f, 0.0f, 1.0f) * glm::clamp((1.0f - heightPercent)/0.2f, 0.0f, 1.0f);
+
+    density *= edgeWeight*heightReduction;
+    density -= coverage;
+    density *= 2;
+
+    return glm::clamp(density, 0.0f, 1.0f);
+}
+
+float sampleDensity(vec3 position) {
+    vec3 shapePosition = (position + cloudOffset)/cloudScale;
+    vec3 detailPosition = (position + detailOffset)/cloudScale;
+    float density = 0;
+
+    // 2 octaves of worley
+    for (int i = 0; i < 2; i++) {
+        density += worley_noise(shapePosition, powf(2, -i)) * powf(2, -i);
+    }
+
+    // 5 octaves of perlin
+    for (int i = 0; i < 5; i++) {
+        density += perlin_noise(detailPosition, powf(2, i+1)) * powf(2, -i);
+    }
+
+    return densityFalloff(position, density);
+}
+
+// Branch-free slab test, misses return the same (10001, 0) as intersectBox. Axes the ray is parallel to never bound
+// it, the origin just has to lie within that slab, selected with mix so the inf and NaN of 1/0 are discarded
+vec2 intersectBoxSlab(vec3 rayo, vec3 rayd) {
+    vec3 boxMin = vec3(boundingBox[0], boundingBox[1], boundingBox[2]);
+    vec3 boxMax = vec3(boundingBox[3], boundingBox[4], boundingBox[5]);
+
+    vec3 invDir = 1.0f/rayd;
+    vec3 t0 = (boxMin - rayo)*invDir;
+    vec3 t1 = (boxMax - rayo)*invDir;
+
+    glm::bvec3 parallel = glm::equal(rayd, vec3(0.0f));
+    glm::bvec3 outside = glm::notEqual(glm::clamp(rayo, boxMin - .00001f, boxMax + .00001f), rayo);
+    vec3 parallelNear = glm::mix(vec3(-10001), vec3(10001), outside);
+
+    vec3 tNear = glm::mix(glm::min(t0, t1), parallelNear, parallel);
+    vec3 tFar = glm::mix(glm::max(t0, t1), -parallelNear, parallel);
+
+    float enter = glm::max(glm::max(glm::max(tNear.x, tNear.y), tNear.z), 0.0f);
+    float exit = glm::min(glm::min(tFar.x, tFar.y), tFar.z);
+
+    return enter <= exit ? vec2(enter, exit) : vec2(10001, 0);
+}
+
+// PCG hashes from Jarzynski and Olano, "Hash Functions for GPU Rendering"
+uint32_t pcg(uint32_t v) {
+    uint32_t state = v*747796405u + 2891336453u;
+    uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state)*277803737u;
+    return (word >> 22u) ^ word;
+}
+
+uvec3 pcg3d(uvec3 v) {
+    v = v*1664525u + 1013904223u;
+    v.x += v.y*v.z;
+    v.y += v.z*v.x;
+    v.z += v.x*v.y;
+    v ^= v >> 16u;
+    v.x += v.y*v.z;
+    v.y += v.z*v.x;
+    v.z += v.x*v.y;
+    return v;
+}
+
+// Top 24 bits so the result stays below 1.0
+float rand1Int(float n) {
+    uint32_t bits;
+    memcpy(&bits, &n, sizeof(float));
+    return (pcg(bits) >> 8u)*(1.0f/16777216.0f);
+}
+
+vec3 rand3Int(vec3 n) {
+    return vec3(pcg3d(uvec3(glm::ivec3(n))) >> 8u)*(1.0f/16777216.0f);
+}
+
+vec3 hash33Int(vec3 p3) {
+    return -1.0f + 2.0f*vec3(pcg3d(uvec3(glm::ivec3(p3))) >> 8u)*(1.0f/16777216.0f);
+}
+
+float worley_noiseInt(vec3 n, float s) {
+    float dis = 10001.0f;
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            for (int z = -1; z <= 1; z++) {
+                vec3 p = glm::floor(n/s) + vec3(x, y, z);
+                float d = glm::length(rand3Int(p) + vec3(x, y, z) - glm::fract(n/s));
+                if (dis > d) {
+                    dis = d;
+                }
+            }
+        }
+    }
+    return 1.0f - dis;
+}
+
+float perlin_noiseInt(vec3 p, float scale) {
+    p *= scale;
+
+    vec3 pi = glm::floor(p);
+    vec3 pf = p - pi;
+
+    vec3 w = pf * pf * (3.0f - 2.0f * pf);
+
+    return glm::mix(
+               glm::mix(
+                   glm::mix(glm::dot(pf - vec3(0, 0, 0), hash33Int(pi + vec3(0, 0, 0))),
+                            glm::dot(pf - vec3(1, 0, 0), hash33Int(pi + vec3(1, 0, 0))),
+                            w.x),
+                   glm::mix(glm::dot(pf - vec3(0, 0, 1), hash33Int(pi + vec3(0, 0, 1))),
+                            glm::dot(pf - vec3(1, 0, 1), hash33Int(pi + vec3(1, 0, 1))),
+                            w.x),
+                   w.z),
+               glm::mix(
+                   glm::mix(glm::dot(pf - vec3(0, 1, 0), hash33Int(pi + vec3(0, 1, 0))),
+                            glm::dot(pf - vec3(1, 1, 0), hash33Int(pi + vec3(1, 1, 0))),
+                            w.x),
+                   glm::mix(glm::dot(pf - vec3(0, 1, 1), hash33Int(pi + vec3(0, 1, 1))),
+                            glm::dot(pf - vec3(1, 1, 1), hash33Int(pi + vec3(1, 1, 1))),
+                            w.x),
+                   w.z),
+               w.y);
+}
+
+const float worleyWeights[2] = {1.0f, 0.5f};
+const float perlinScales[5] = {2.0f, 4.0f, 8.0f, 16.0f, 32.0f};
+const float perlinWeights[5] = {1.0f, 0.5f, 0.25f, 0.125f, 0.0625f};
+
+// Same as sampleDensity with the pow(2, i) octave weights precomputed
+float sampleDensityWeights(vec3 position) {
+    vec3 shapePosition = (position + cloudOffset)/cloudScale;
+    vec3 detailPosition = (position + detailOffset)/cloudScale;
+    float density = 0;
+
+    for (int i = 0; i < 2; i++) {
+        density += worley_noise(shapePosition, worleyWeights[i]) * worleyWeights[i];
+    }
+
+    for (int i = 0; i < 5; i++) {
+        density += perlin_noise(detailPosition, perlinScales[i]) * perlinWeights[i];
+    }
+
+    return densityFalloff(position, density);
+}
+
+// ---- Entry points, matching the ones in kernelBench.cs ----
+
+vec4 benchHash33(vec4 a, vec4 b) { return vec4(hash33(glm::floor(vec3(a))), 0.0f); }
+vec4 benchHash33Int(vec4 a, vec4 b) { return vec4(hash33Int(glm::floor(vec3(a))), 0.0f); }
+vec4 benchRand1(vec4 a, vec4 b) { return vec4(rand1(a.x), 0.0f, 0.0f, 0.0f); }
+vec4 benchRand1Int(vec4 a, vec4 b) { return vec4(rand1Int(a.x), 0.0f, 0.0f, 0.0f); }
+vec4 benchRand3(vec4 a, vec4 b) { return vec4(rand3(glm::floor(vec3(a))), 0.0f); }
+vec4 benchRand3Int(vec4 a, vec4 b) { return vec4(rand3Int(glm::floor(vec3(a))), 0.0f); }
+vec4 benchWorley(vec4 a, vec4 b) { return vec4(worley_noise(vec3(a)/cloudScale, 1.0f), 0.0f, 0.0f, 0.0f); }
+vec4 benchWorleyInt(vec4 a, vec4 b) { return vec4(worley_noiseInt(vec3(a)/cloudScale, 1.0f), 0.0f, 0.0f, 0.0f); }
+vec4 benchPerlin(vec4 a, vec4 b) { return vec4(perlin_noise(vec3(a)/cloudScale, 2.0f), 0.0f, 0.0f, 0.0f); }
+vec4 benchPerlinInt(vec4 a, vec4 b) { return vec4(perlin_noiseInt(vec3(a)/cloudScale, 2.0f), 0.0f, 0.0f, 0.0f); }
+vec4 benchIntersectBox(vec4 a, vec4 b) { return vec4(intersectBox(vec3(a), vec3(b)), 0.0f, 0.0f); }
+vec4 benchIntersectBoxSlab(vec4 a, vec4 b) { return vec4(intersectBoxSlab(vec3(a), vec3(b)), 0.0f, 0.0f); }
+vec4 benchSampleDensity(vec4 a, vec4 b) { return vec4(sampleDensity(vec3(a)), 0.0f, 0.0f, 0.0f); }
+vec4 benchSampleDensityWeights(vec4 a, vec4 b) { return vec4(sampleDensityWeights(vec3(a)), 0.0f, 0.0f, 0.0f); }
+
+// The fract based hashes amplify rounding differences between the GPU and the C++ math library, so the ports of the
+// kernels built on them only have to agree on average
+kernelBench benches[] = {
+    {"hash33", "benchHash33", "benchHash33Int", benchHash33, benchHash33Int, "pcg3d integer hash", false, 1e-2f},
+    {"rand1", "benchRand1", "benchRand1Int", benchRand1, benchRand1Int, "pcg integer hash", false, 5e-2f},
+    {"rand3", "benchRand3", "benchRand3Int", benchRand3, benchRand3Int, "pcg3d integer hash", false, 5e-2f},
+    {"worley_noise", "benchWorley", "benchWorleyInt", benchWorley, benchWorleyInt, "pcg3d rand3", false, 5e-2f},
+    {"perlin_noise", "benchPerlin", "benchPerlinInt", benchPerlin, benchPerlinInt, "pcg3d hash33", false, 1e-2f},
+    {"intersectBox", "benchIntersectBox", "benchIntersectBoxSlab", benchIntersectBox, benchIntersectBoxSlab,
+     "branch-free slab test", true, 1e-4f},
+    {"sampleDensity", "benchSampleDensity", "benchSampleDensityWeights", benchSampleDensity, benchSampleDensityWeights,
+     "precomputed octave weights", true, 5e-2f},
+};
+
+void readShader(const char* fname, std::string &source)
+{
+    FILE *fp;
+    fp = fopen(fname,"r");
+    if (fp==NULL)
+    {
+        fprintf(stderr,"The shader file %s cannot be opened!\n",fname);
+        glfwTerminate();
+        exit(1);
+    }
+    char tmp[300];
+    while (fgets(tmp,300,fp)!=NULL)
+    {
+        source += tmp;
+    }
+    fclose(fp);
+}
+
+// Each kernel gets its own program so the compiler can drop the others
+GLuint loadKernel(const std::string &noise, const std::string &source, const char *kernel)
+{
+    std::string header = "#version 430 core\n#define KERNEL " + std::string(kernel) + "\n";
+    const char *sources[3] = {header.c_str(), noise.c_str(), source.c_str()};
+
+    GLuint cs = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(cs, 3, sources, NULL);
+    glCompileShader(cs);
+
+    GLint status;
+    glGetShaderiv(cs, GL_COMPILE_STATUS, &status);
+    if (!status) {
+        char error[1000];
+        glGetShaderInfoLog(cs, 1000, NULL, error);
+        fprintf(stderr, "Compile error in %s: \n %s\n", kernel, error);
+        glfwTerminate();
+        exit(1);
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, cs);
+    glLinkProgram(program);
+    glDeleteShader(cs);
+
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (!status) {
+        char error[1000];
+        glGetProgramInfoLog(program, 1000, NULL, error);
+        fprintf(stderr, "Link error in %s: \n %s\n", kernel, error);
+        glfwTerminate();
+        exit(1);
+    }
+
+    return program;
+}
+
+// Fill cloudData with the layout this program reports and bind it, kernels that do not use it are skipped
+void bindCloudData(GLuint program) {
+    GLuint blockIndex = glGetUniformBlockIndex(program, "cloudData");
+    if (blockIndex == GL_INVALID_INDEX) {
+        return;
+    }
+
+    GLint blockSize;
+    glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+    std::vector<GLubyte> blockBuffer(blockSize, 0);
+
+    const GLchar* cloudComponents[8] = {"coverage", "mainStepCount", "lightStepCount", "cloudColor", "boundingBox",
+                                        "cloudScale", "cloudOffset", "detailOffset"};
+    GLuint indices[8];
+    glGetUniformIndices(program, 8, cloudComponents, indices);
+
+    GLint offsets[8], strides[8];
+    glGetActiveUniformsiv(program, 8, indices, GL_UNIFORM_OFFSET, offsets);
+    glGetActiveUniformsiv(program, 8, indices, GL_UNIFORM_ARRAY_STRIDE, strides);
+
+    memcpy(blockBuffer.data() + offsets[0], &coverage, sizeof(float));
+    memcpy(blockBuffer.data() + offsets[1], &mainStepCount, sizeof(int));
+    memcpy(blockBuffer.data() + offsets[2], &lightStepCount, sizeof(int));
+    memcpy(blockBuffer.data() + offsets[3], &cloudColor, sizeof(vec4));
+    for (int i = 0; i < 6; i++) {
+        memcpy(blockBuffer.data() + offsets[4] + i*strides[4], &boundingBox[i], sizeof(float));
+    }
+    memcpy(blockBuffer.data() + offsets[5], &cloudScale, sizeof(float));
+    memcpy(blockBuffer.data() + offsets[6], &cloudOffset, sizeof(vec3));
+    memcpy(blockBuffer.data() + offsets[7], &detailOffset, sizeof(vec3));
+
+    glBindBuffer(GL_UNIFORM_BUFFER, cloudBuf);
+    glBufferData(GL_UNIFORM_BUFFER, blockSize, blockBuffer.data(), GL_STATIC_DRAW);
+
+    glUniformBlockBinding(program, blockIndex, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, cloudBuf);
+}
+
+static void error_callback(int error, const char* description)
+{
+    fprintf(stderr, "Error: %s\n", description);
+}
+
+// Sample positions around the bounding box and random unit ray directions. Every fourth ray is parallel to a box
+// plane or axis aligned, and half of those start on that plane, so the zero direction branches of intersectBox are hit
+void generatePoints(std::vector<vec4> &points) {
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    points.resize(2*pointCount);
+    for (int i = 0; i < pointCount; i++) {
+        vec3 position = vec3(12.0f*unit(gen), 10.0f + 9.0f*unit(gen), 12.0f*unit(gen));
+        int axis = (i/4) % 3;
+
+        vec3 direction;
+        do {
+            direction = vec3(unit(gen), unit(gen), unit(gen));
+            if (i % 4 == 0) {
+                direction[axis] = 0.0f;
+                if ((i/4) % 2 == 0) {
+                    direction[(axis + 1) % 3] = 0.0f;
+                }
+            }
+        } while (glm::length(direction) < .01f || glm::length(direction) > 1.0f);
+
+        if (i % 8 == 0) {
+            position[axis] = boundingBox[axis + 3*((i/8) % 2)];
+        }
+
+        points[2*i] = vec4(position, 1.0f);
+        points[2*i + 1] = vec4(glm::normalize(direction), 0.0f);
+    }
+}
+
+// Best of the repetitions, in points per second
+double runGPU(GLuint program, std::vector<vec4> &results) {
+    GLuint groups = (pointCount + 63)/64;
+    double best = 0.0;
+
+    glUseProgram(program);
+    glUniform1ui(glGetUniformLocation(program, "count"), pointCount);
+
+    // Warm up so the first dispatch does not pay for the shader upload
+    glDispatchCompute(groups, 1, 1);
+
+    for (int r = 0; r < repetitions; r++) {
+        glBeginQuery(GL_TIME_ELAPSED, timerQuery);
+        glDispatchCompute(groups, 1, 1);
+        glEndQuery(GL_TIME_ELAPSED);
+
+        GLuint64 elapsed;
+        glGetQueryObjectui64v(timerQuery, GL_QUERY_RESULT, &elapsed);
+
+        double rate = pointCount/(elapsed/1e9);
+        if (rate > best) {
+            best = rate;
+        }
+    }
+
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    results.resize(pointCount);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, outputBuf);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, pointCount*sizeof(vec4), results.data());
+
+    return best;
+}
+
+double runCPU(cpuKernel kernel, const std::vector<vec4> &points, std::vector<vec4> &results) {
+    double best = 0.0;
+
+    results.resize(pointCount);
+    for (int r = 0; r < repetitions; r++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < pointCount; i++) {
+            results[i] = kernel(points[2*i], points[2*i + 1]);
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        double rate = pointCount/elapsed.count();
+        if (rate > best) {
+            best = rate;
+        }
+    }
+
+    return best;
+}
+
+void compareResults(const std::vector<vec4> &current, const std::vector<vec4> &alternative, benchResult &result) {
+    double total = 0.0;
+
+    result.maxDiff = 0.0f;
+    for (int i = 0; i < pointCount; i++) {
+        vec4 diff = glm::abs(current[i] - alternative[i]);
+        float d = glm::max(glm::max(diff.x, diff.y), glm::max(diff.z, diff.w));
+        if (d > result.maxDiff) {
+            result.maxDiff = d;
+        }
+        total += d;
+    }
+    result.meanDiff = total/pointCount;
+}
+
+void printResult(const char *name, const char *backend, const kernelBench &bench, const benchResult &result) {
+    const char *check = "differs by design";
+    if (bench.exact) {
+        check = result.maxDiff < 1e-4f ? "match" : "MISMATCH";
+    }
+
+    printf("%-14s %-4s %12.2f %12.2f %8.2fx %12.3e %12.3e  %s\n", name, backend,
+           result.currentRate/1e6, result.alternativeRate/1e6, result.alternativeRate/result.currentRate,
+           result.maxDiff, result.meanDiff, check);
+}
+
+// How far the C++ port of the current kernel is from the shipped GLSL one
+void printPort(const char *name, const kernelBench &bench, const benchResult &result) {
+    printf("%-14s %-4s %12s %12s %9s %12.3e %12.3e  %s\n", name, "port", "", "", "",
+           result.maxDiff, result.meanDiff, result.meanDiff <= bench.portTolerance ? "match" : "MISMATCH");
+}
+
+int main(int argc, char** argv) {
+    GLFWwindow* window;
+
+    if (argc > 1) {
+        pointCount = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        repetitions = atoi(argv[2]);
+    }
+
+    // A single dispatch can have at most 65535 work groups
+    if (pointCount < 1 || pointCount > 65535*64) {
+        fprintf(stderr, "The point count must be between 1 and %d\n", 65535*64);
+        exit(EXIT_FAILURE);
+    }
+    if (repetitions < 1) {
+        repetitions = 1;
+    }
+
+    glfwSetErrorCallback(error_callback);
+    if (!glfwInit())
+        exit(EXIT_FAILURE);
+
+    // Compute shaders need 4.3, the window is never shown
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    window = glfwCreateWindow(64, 64, "KernelBench", NULL, NULL);
+    if (!window)
+    {
+        glfwTerminate();
+        exit(EXIT_FAILURE);
+    }
+    glfwMakeContextCurrent(window);
+
+    gladLoadGL();
+
+    printf("GL Renderer          : %s\n", glGetString(GL_RENDERER));
+    printf("GL Version (string)  : %s\n", glGetString(GL_VERSION));
+    printf("Points               : %d, best of %d runs\n\n", pointCount, repetitions);
+
+    setCloudDefaults();
+
+    std::vector<vec4> points;
+    generatePoints(points);
+
+    glGenBuffers(1, &inputBuf);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, inputBuf);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, points.size()*sizeof(vec4), points.data(), GL_STATIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, inputBuf);
+
+    glGenBuffers(1, &outputBuf);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, outputBuf);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, pointCount*sizeof(vec4), NULL, GL_DYNAMIC_READ);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, outputBuf);
+
+    glGenBuffers(1, &cloudBuf);
+
+    glGenQueries(1, &timerQuery);
+
+    std::string noise, source;
+    readShader("cloudNoise.glsl", noise);
+    readShader("kernelBench.cs", source);
+
+    printf("%-14s %-4s %12s %12s %9s %12s %12s  %s\n", "kernel", "", "current M/s", "alt M/s", "speedup",
+           "max |diff|", "mean |diff|", "check");
+
+    std::vector<vec4> gpuCurrent, current, alternative;
+    for (const kernelBench &bench : benches) {
+        benchResult result;
+
+        GLuint currentProgram = loadKernel(noise, source, bench.gpuCurrent);
+        GLuint alternativeProgram = loadKernel(noise, source, bench.gpuAlternative);
+
+        bindCloudData(currentProgram);
+        result.currentRate = runGPU(currentProgram, current);
+        bindCloudData(alternativeProgram);
+        result.alternativeRate = runGPU(alternativeProgram, alternative);
+        compareResults(current, alternative, result);
+        printResult(bench.name, "gpu", bench, result);
+        gpuCurrent.swap(current);
+
+        glDeleteProgram(currentProgram);
+        glDeleteProgram(alternativeProgram);
+
+        result.currentRate = runCPU(bench.cpuCurrent, points, current);
+        result.alternativeRate = runCPU(bench.cpuAlternative, points, alternative);
+        compareResults(current, alternative, result);
+        printResult(bench.name, "cpu", bench, result);
+
+        compareResults(gpuCurrent, current, result);
+        printPort(bench.name, bench, result);
+
+        printf("%-14s alternative: %s\n\n", "", bench.alternative);
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    exit(EXIT_SUCCESS);
+}
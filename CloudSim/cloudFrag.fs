@@ -1,4 +1,4 @@
-#version 420 core
+// cloudNoise.glsl and the #version line are prepended by CloudSim.cpp
 
 layout (location=0) in vec2 texCoord;
 layout (binding=0) uniform sampler2D ColorData;
@@ -21,17 +21,14 @@ uniform camData {
     float farClip;
 };
 
-uniform cloudData {
-    float coverage;
-    int mainStepCount;
-    int lightStepCount;
-    vec4 cloudColor;
-    float boundingBox[6];
-    float cloudScale;
-    vec3 cloudOffset;
-    vec3 detailOffset;
+uniform shadowData {
+    vec4 shadowBounds;
+    float shadowTop;
 };
 
+subroutine void passType();
+subroutine uniform passType renderPass;
+
 vec3 rayo, rayd;
 
 void generateRay() {
@@ -58,144 +55,6 @@ float getDepth()  {
     return linearDepth;
 }
 
-vec2 intersectBox(vec3 rayo, vec3 rayd) {
-    float t[6] = {10001, 10001, 10001, 10001, 10001, 10001};
-
-    if (rayd.x != 0) {
-        t[0] = (boundingBox[0] - rayo.x)/rayd.x;
-        t[3] = (boundingBox[3] - rayo.x)/rayd.x;
-    }
-    if (rayd.y != 0) {
-        t[1] = (boundingBox[1] - rayo.y)/rayd.y;
-        t[4] = (boundingBox[4] - rayo.y)/rayd.y;
-    }
-    if (rayd.z != 0) {
-        t[2] = (boundingBox[2] - rayo.z)/rayd.z;
-        t[5] = (boundingBox[5] - rayo.z)/rayd.z;
-    }
-
-    float min = 10001;
-    float max = 0;
-    for (int i = 0; i < 6; i++) {
-        if (t[i] < 0) {
-            t[i] = 0;
-        }
-        vec3 point = rayo + t[i]*rayd;
-        if (point.x >= boundingBox[0] - .00001 && point.x <= boundingBox[3] + .00001 &&
-            point.y >= boundingBox[1] - .00001 && point.y <= boundingBox[4] + .00001 &&
-            point.z >= boundingBox[2] - .00001 && point.z <= boundingBox[5] + .00001) {
-            if (t[i] < min) {
-                min = t[i];
-            }
-            if (t[i] > max) {
-                max = t[i];
-            }
-        }
-    }
-
-    return vec2(min, max);
-}
-
-float rand1(float n) {
- 	return fract(cos(n*89.42)*343.42);
-}
-
-vec3 rand3(vec3 n) {
- 	return vec3(rand1(n.x*23.62 + n.y*34.35 + n.z*29.39 - 300.0),
- 	            rand1(n.x*45.13 + n.y*38.89 + n.z*41.05 + 256.0),
- 	            rand1(n.x*25.97 + n.y*35.48 + n.z*38.20 - 134.6));
-}
-
-vec3 hash33(vec3 p3) {
-	p3 = fract(p3 * vec3(0.1031, 0.11369, 0.13787));
-    p3 += dot(p3, p3.yxz + 19.19);
-    return -1.0 + 2.0 * fract(vec3((p3.x + p3.y)*p3.z, (p3.x + p3.z)*p3.y, (p3.y + p3.z)*p3.x));
-}
-
-// Adapted from https://www.shadertoy.com/view/4l2GzW
-float worley_noise(vec3 n, float s) {
-    float dis = 10001.0;
-    for (int x = -1; x <= 1; x++) {
-        for (int y = -1; y <= 1; y++) {
-            for (int z = -1; z <= 1; z++) {
-                vec3 p = floor(n/s) + vec3(x, y, z);
-                float d = length(rand3(p) + vec3(x, y, z) - fract(n/s));
-                if (dis > d) {
-                    dis = d;
-                }
-            }
-        }
-    }
-    return 1.0 - dis;
-}
-
-// From https://www.shadertoy.com/view/4sc3z2
-float perlin_noise(vec3 p, float scale) {
-    p *= scale;
-
-    vec3 pi = floor(p);
-    vec3 pf = p - pi;
-
-    vec3 w = pf * pf * (3.0 - 2.0 * pf);
-
-    return 	mix(
-        		mix(
-                	mix(dot(pf - vec3(0, 0, 0), hash33(pi + vec3(0, 0, 0))),
-                        dot(pf - vec3(1, 0, 0), hash33(pi + vec3(1, 0, 0))),
-                       	w.x),
-                	mix(dot(pf - vec3(0, 0, 1), hash33(pi + vec3(0, 0, 1))),
-                        dot(pf - vec3(1, 0, 1), hash33(pi + vec3(1, 0, 1))),
-                       	w.x),
-                	w.z),
-        		mix(
-                    mix(dot(pf - vec3(0, 1, 0), hash33(pi + vec3(0, 1, 0))),
-                        dot(pf - vec3(1, 1, 0), hash33(pi + vec3(1, 1, 0))),
-                       	w.x),
-                   	mix(dot(pf - vec3(0, 1, 1), hash33(pi + vec3(0, 1, 1))),
-                        dot(pf - vec3(1, 1, 1), hash33(pi + vec3(1, 1, 1))),
-                       	w.x),
-                	w.z),
-    			w.y);
-}
-
-float sampleDensity(vec3 position) {
-    vec3 shapePosition = (position + cloudOffset)/cloudScale;
-    vec3 detailPosition = (position + detailOffset)/cloudScale;
-    float density = 0;
-
-    // 2 octaves of worley
-    for (int i = 0; i < 2; i++) {
-        density += worley_noise(shapePosition, pow(2, -i)) * pow(2, -i);
-    }
-
-    // 5 octaves of perlin
-    for (int i = 0; i < 5; i++) {
-            density += perlin_noise(detailPosition, pow(2, i+1)) * pow(2, -i);
-    }
-
-    // Edge fall off
-    float distX = min(position.x - boundingBox[0], boundingBox[3] - position.x);
-    float distZ = min(position.z - boundingBox[2], boundingBox[5] - position.z);
-
-    float edgeWeight = min(1, min(distX, distZ))/1;
-
-    // Normalized height in the box
-    float heightPercent = (position.y - boundingBox[1]) / (boundingBox[4] - boundingBox[1]);
-    // Reduce noise below .2 and above .8 height
-    float heightReduction = clamp(heightPercent/0.2, 0.0, 1.0) * clamp((1.0 - heightPercent)/0.2, 0.0, 1.0);
-
-    edgeWeight *= heightReduction;
-    density *= edgeWeight;
-
-    // Make gaps in the noise
-    density -= coverage;
-
-    // Increase the density to make the edge between cloud and sky sharper
-    density *= 2;
-
-    return clamp(density, 0.0, 1.0);
-}
-
 float lightRayMarch(vec3 startPoint, vec3 endPoint) {
     vec3 stepDirection = normalize(endPoint - startPoint);
 
@@ -248,7 +107,7 @@ vec2 rayMarch(vec3 startPoint, vec3 endPoint) {
     return vec2(totalLight, exp(-totalDensity));
 }
 
-void rayMarchNoise() {
+subroutine(passType) void rayMarchNoise() {
     ivec2 pixel = ivec2(gl_FragCoord.xy);
     vec4 color = texelFetch(ColorData, pixel, 0);
     float depth = getDepth();
@@ -272,6 +131,32 @@ void rayMarchNoise() {
     }
 }
 
+// Optical depth between a point on the ground and the light, stored in the shadow map
+subroutine(passType) void bakeShadow() {
+    vec3 groundPoint = vec3(mix(shadowBounds.x, shadowBounds.z, texCoord.x), 0.0,
+                            mix(shadowBounds.y, shadowBounds.w, texCoord.y));
+    vec3 lightDirection = normalize(lightPosition.xyz - groundPoint);
+
+    vec2 t = intersectBox(groundPoint, lightDirection);
+    t.y = min(t.y, length(lightPosition.xyz - groundPoint));
+
+    FragColor = vec4(0.0);
+
+    if (t.x < 10000 && t.y > t.x) {
+        float stepDistance = (t.y - t.x)/(mainStepCount-1);
+
+        float totalDensity = 0;
+        vec3 point = groundPoint + t.x*lightDirection;
+        for (int i = 0; i < mainStepCount; i++) {
+            totalDensity += sampleDensity(point) * stepDistance;
+
+            point += stepDistance*lightDirection;
+        }
+
+        FragColor = vec4(totalDensity);
+    }
+}
+
 void main() {
-    rayMarchNoise();
+    renderPass();
 }
\ No newline at end of file
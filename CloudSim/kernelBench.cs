@@ -0,0 +1,162 @@
+// The #version line, the KERNEL define and cloudNoise.glsl are prepended by KernelBench.cpp, so each kernel is its
+// own program and the current kernels are the ones cloudFrag.fs runs
+
+layout (local_size_x = 64) in;
+
+// Two vec4 per point, a is the sample position or ray origin, b the ray direction
+layout (std430, binding=0) readonly buffer inputData {
+    vec4 points[];
+};
+
+layout (std430, binding=1) writeonly buffer outputData {
+    vec4 results[];
+};
+
+uniform uint count;
+
+// ---- Alternatives ----
+
+// Branch-free slab test, misses return the same (10001, 0) as intersectBox. Axes the ray is parallel to never bound
+// it, the origin just has to lie within that slab, selected with mix so the inf and NaN of 1/0 are discarded
+vec2 intersectBoxSlab(vec3 rayo, vec3 rayd) {
+    vec3 boxMin = vec3(boundingBox[0], boundingBox[1], boundingBox[2]);
+    vec3 boxMax = vec3(boundingBox[3], boundingBox[4], boundingBox[5]);
+
+    vec3 invDir = 1.0/rayd;
+    vec3 t0 = (boxMin - rayo)*invDir;
+    vec3 t1 = (boxMax - rayo)*invDir;
+
+    bvec3 parallel = equal(rayd, vec3(0.0));
+    bvec3 outside = notEqual(clamp(rayo, boxMin - .00001, boxMax + .00001), rayo);
+    vec3 parallelNear = mix(vec3(-10001), vec3(10001), outside);
+
+    vec3 tNear = mix(min(t0, t1), parallelNear, parallel);
+    vec3 tFar = mix(max(t0, t1), -parallelNear, parallel);
+
+    float enter = max(max(max(tNear.x, tNear.y), tNear.z), 0.0);
+    float exit = min(min(tFar.x, tFar.y), tFar.z);
+
+    return enter <= exit ? vec2(enter, exit) : vec2(10001, 0);
+}
+
+// PCG hashes from Jarzynski and Olano, "Hash Functions for GPU Rendering"
+uint pcg(uint v) {
+    uint state = v*747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state)*277803737u;
+    return (word >> 22u) ^ word;
+}
+
+uvec3 pcg3d(uvec3 v) {
+    v = v*1664525u + 1013904223u;
+    v.x += v.y*v.z;
+    v.y += v.z*v.x;
+    v.z += v.x*v.y;
+    v ^= v >> 16u;
+    v.x += v.y*v.z;
+    v.y += v.z*v.x;
+    v.z += v.x*v.y;
+    return v;
+}
+
+// Top 24 bits so the result stays below 1.0
+float rand1Int(float n) {
+    return float(pcg(floatBitsToUint(n)) >> 8u)*(1.0/16777216.0);
+}
+
+// Only valid for lattice points, which is how worley_noise calls it
+vec3 rand3Int(vec3 n) {
+    return vec3(pcg3d(uvec3(ivec3(n))) >> 8u)*(1.0/16777216.0);
+}
+
+vec3 hash33Int(vec3 p3) {
+    return -1.0 + 2.0*vec3(pcg3d(uvec3(ivec3(p3))) >> 8u)*(1.0/16777216.0);
+}
+
+float worley_noiseInt(vec3 n, float s) {
+    float dis = 10001.0;
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            for (int z = -1; z <= 1; z++) {
+                vec3 p = floor(n/s) + vec3(x, y, z);
+                float d = length(rand3Int(p) + vec3(x, y, z) - fract(n/s));
+                if (dis > d) {
+                    dis = d;
+                }
+            }
+        }
+    }
+    return 1.0 - dis;
+}
+
+float perlin_noiseInt(vec3 p, float scale) {
+    p *= scale;
+
+    vec3 pi = floor(p);
+    vec3 pf = p - pi;
+
+    vec3 w = pf * pf * (3.0 - 2.0 * pf);
+
+    return 	mix(
+        		mix(
+                	mix(dot(pf - vec3(0, 0, 0), hash33Int(pi + vec3(0, 0, 0))),
+                        dot(pf - vec3(1, 0, 0), hash33Int(pi + vec3(1, 0, 0))),
+                       	w.x),
+                	mix(dot(pf - vec3(0, 0, 1), hash33Int(pi + vec3(0, 0, 1))),
+                        dot(pf - vec3(1, 0, 1), hash33Int(pi + vec3(1, 0, 1))),
+                       	w.x),
+                	w.z),
+        		mix(
+                    mix(dot(pf - vec3(0, 1, 0), hash33Int(pi + vec3(0, 1, 0))),
+                        dot(pf - vec3(1, 1, 0), hash33Int(pi + vec3(1, 1, 0))),
+                       	w.x),
+                   	mix(dot(pf - vec3(0, 1, 1), hash33Int(pi + vec3(0, 1, 1))),
+                        dot(pf - vec3(1, 1, 1), hash33Int(pi + vec3(1, 1, 1))),
+                       	w.x),
+                	w.z),
+    			w.y);
+}
+
+const float worleyWeights[2] = float[2](1.0, 0.5);
+const float perlinScales[5] = float[5](2.0, 4.0, 8.0, 16.0, 32.0);
+const float perlinWeights[5] = float[5](1.0, 0.5, 0.25, 0.125, 0.0625);
+
+// Same as sampleDensity with the pow(2, i) octave weights precomputed
+float sampleDensityWeights(vec3 position) {
+    vec3 shapePosition = (position + cloudOffset)/cloudScale;
+    vec3 detailPosition = (position + detailOffset)/cloudScale;
+    float density = 0;
+
+    for (int i = 0; i < 2; i++) {
+        density += worley_noise(shapePosition, worleyWeights[i]) * worleyWeights[i];
+    }
+
+    for (int i = 0; i < 5; i++) {
+            density += perlin_noise(detailPosition, perlinScales[i]) * perlinWeights[i];
+    }
+
+    return densityFalloff(position, density);
+}
+
+// ---- Entry points, selected with KERNEL ----
+
+vec4 benchHash33(vec4 a, vec4 b) { return vec4(hash33(floor(a.xyz)), 0.0); }
+vec4 benchHash33Int(vec4 a, vec4 b) { return vec4(hash33Int(floor(a.xyz)), 0.0); }
+vec4 benchRand1(vec4 a, vec4 b) { return vec4(rand1(a.x), 0.0, 0.0, 0.0); }
+vec4 benchRand1Int(vec4 a, vec4 b) { return vec4(rand1Int(a.x), 0.0, 0.0, 0.0); }
+vec4 benchRand3(vec4 a, vec4 b) { return vec4(rand3(floor(a.xyz)), 0.0); }
+vec4 benchRand3Int(vec4 a, vec4 b) { return vec4(rand3Int(floor(a.xyz)), 0.0); }
+vec4 benchWorley(vec4 a, vec4 b) { return vec4(worley_noise(a.xyz/cloudScale, 1.0), 0.0, 0.0, 0.0); }
+vec4 benchWorleyInt(vec4 a, vec4 b) { return vec4(worley_noiseInt(a.xyz/cloudScale, 1.0), 0.0, 0.0, 0.0); }
+vec4 benchPerlin(vec4 a, vec4 b) { return vec4(perlin_noise(a.xyz/cloudScale, 2.0), 0.0, 0.0, 0.0); }
+vec4 benchPerlinInt(vec4 a, vec4 b) { return vec4(perlin_noiseInt(a.xyz/cloudScale, 2.0), 0.0, 0.0, 0.0); }
+vec4 benchIntersectBox(vec4 a, vec4 b) { return vec4(intersectBox(a.xyz, b.xyz), 0.0, 0.0); }
+vec4 benchIntersectBoxSlab(vec4 a, vec4 b) { return vec4(intersectBoxSlab(a.xyz, b.xyz), 0.0, 0.0); }
+vec4 benchSampleDensity(vec4 a, vec4 b) { return vec4(sampleDensity(a.xyz), 0.0, 0.0, 0.0); }
+vec4 benchSampleDensityWeights(vec4 a, vec4 b) { return vec4(sampleDensityWeights(a.xyz), 0.0, 0.0, 0.0); }
+
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i < count) {
+        results[i] = KERNEL(points[2u*i], points[2u*i + 1u]);
+    }
+}
@@ -1,7 +1,9 @@
-#version 410 core
+#version 420 core
 
 layout (location=0) in vec3 Position;
 layout (location=1) in vec3 Normal;
+layout (location=2) in vec3 WorldPosition;
+layout (binding=2) uniform sampler2D ShadowMap;
 
 layout (location=0) out vec4 FragColor;
 
@@ -26,6 +28,27 @@ uniform materialData {
     float shine;
 };
 
+uniform shadowData {
+    vec4 shadowBounds;
+    float shadowTop;
+};
+
+float cloudShadow() {
+    // Nothing above the top of the clouds can be shadowed by them. The map holds the full optical depth from the
+    // ground, so it overestimates the shadow for fragments inside the cloud box
+    if (WorldPosition.y >= min(shadowTop, lightPosition.y)) {
+        return 1.0;
+    }
+
+    // Project the fragment along the light ray onto the ground, where the shadow map was baked
+    vec3 ground = lightPosition.xyz + (WorldPosition - lightPosition.xyz)*
+                  (lightPosition.y/(lightPosition.y - WorldPosition.y));
+    vec2 shadowCoord = (ground.xz - shadowBounds.xy)/(shadowBounds.zw - shadowBounds.xy);
+
+    // Same extinction as the main cloud ray march
+    return exp(-1.5*texture(ShadowMap, shadowCoord).x);
+}
+
 vec3 blinnPhong () {
     // Calculate ambient
     vec3 intensityAmbient = ambient * reflectionAmbient;
@@ -47,7 +70,8 @@ vec3 blinnPhong () {
         intensitySpec = specular * reflectionSpecular * pow(max(dot(halfway, normalize(Normal)), 0.0), 7*shine);
     }
 
-    return intensityAmbient + intensityDiffuse + intensitySpec;
+    // Clouds only block the direct light
+    return intensityAmbient + cloudShadow()*(intensityDiffuse + intensitySpec);
 }
 
 void main() {
@@ -5,6 +5,7 @@ layout (location=1) in vec3 VertexNormal;
 
 layout (location=0) out vec3 Position;
 layout (location=1) out vec3 Normal;
+layout (location=2) out vec3 WorldPosition;
 
 uniform matrixData {
     mat4 modelMat;
@@ -17,6 +18,7 @@ void main() {
     // Convert to eye space
     Normal = normalize(normalMat * VertexNormal);
     Position = (viewMat * modelMat * vec4(VertexPosition, 1.0)).xyz;
+    WorldPosition = (modelMat * vec4(VertexPosition, 1.0)).xyz;
 
     gl_Position = projectionMat * viewMat * modelMat * vec4(VertexPosition, 1.0);
 }
\ No newline at end of file